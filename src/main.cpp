@@ -1,3 +1,5 @@
+#define ALLOC_COUNTER_IMPLEMENTATION
+#include "utils/alloc_counter.hpp"
 #include "viewpoint.hpp"
 #include "utils/utils_models.hpp"
 #include "utils/utils_loop.hpp"
@@ -5,60 +7,64 @@
 int main()
 {
     Space space;
+    Space::Builder builder(space);
+    builder.reserve(8 + 12); // room + cube
 
     // Floor plane
-    space.addPlane(Plane(
+    builder.addPlane(Plane(
         Vector3(-10, -2, -10),
         Vector3(10, -2, -10),
         Vector3(10, -2, 10)
     ));
-    space.addPlane(Plane(
+    builder.addPlane(Plane(
         Vector3(-10, -2, -10),
         Vector3(10, -2, 10),
         Vector3(-10, -2, 10)
     ));
     
     // Wall 1
-    space.addPlane(Plane(
+    builder.addPlane(Plane(
         Vector3(-5, -2, 5),
         Vector3(5, -2, 5),
         Vector3(5, 3, 5)
     ));
-    space.addPlane(Plane(
+    builder.addPlane(Plane(
         Vector3(-5, -2, 5),
         Vector3(5, 3, 5),
         Vector3(-5, 3, 5)
     ));
     
     // Wall 2
-    space.addPlane(Plane(
+    builder.addPlane(Plane(
         Vector3(-5, -2, -5),
         Vector3(-5, -2, 5),
         Vector3(-5, 3, 5)
     ));
-    space.addPlane(Plane(
+    builder.addPlane(Plane(
         Vector3(-5, -2, -5),
         Vector3(-5, 3, 5),
         Vector3(-5, 3, -5)
     ));
     
     // Wall 3
-    space.addPlane(Plane(
+    builder.addPlane(Plane(
         Vector3(5, -2, -5),
         Vector3(5, 3, -5),
         Vector3(5, 3, 5)
     ));
-    space.addPlane(Plane(
+    builder.addPlane(Plane(
         Vector3(5, -2, -5),
         Vector3(5, 3, 5),
         Vector3(5, -2, 5)
     ));
 
-    addCube(space, Vector3(-2, -1, 0), 2.0);
+    addCube(builder, Vector3(-2, -1, 0), 2.0);
 
-    // addBall(space, Vector3(2, 0, 0), 1.0, 6, 4);
+    // addBall(builder, Vector3(2, 0, 0), 1.0, 6, 4);
 
-    // addCylinder(space, Vector3(0, -1, -3), 0.5, 2.0, 12);
+    // addCylinder(builder, Vector3(0, -1, -3), 0.5, 2.0, 12);
+
+    builder.commit();
 
     Viewpoint viewpoint(
         Vector3(0, 0, 0),  // position
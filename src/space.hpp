@@ -2,22 +2,352 @@
 #define SPACE_HPP
 
 #include "plane.hpp"
+#include "utils/rcu_pointer.hpp"
+#include <algorithm>
+#include <memory>
+#include <mutex>
 #include <vector>
 
+// Scene container that can be edited while frames are in flight.
+// Readers pin an immutable snapshot; writers copy the current version,
+// change the copy and publish it through an RcuPointer, so neither side
+// takes a lock the other one waits on. Versions share their geometry and
+// a version is freed when the last reader holding it drops its pointer.
 class Space
 {
 public:
-    Space() {}
-    
+    using PlanesPtr = std::shared_ptr<const std::vector<Plane>>;
+    using ChunkPtr = PlanesPtr;
+
+    // Plane list shared between versions. The storage only grows: a version
+    // sees its first size() planes and append() writes after them in place
+    // while capacity lasts, so planes a reader can see are never written again.
+    class SharedPlanes
+    {
+    public:
+        const Plane* data() const { return first; }
+        std::size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        const Plane* begin() const { return first; }
+        const Plane* end() const { return first + count; }
+        const Plane& operator[](std::size_t i) const { return first[i]; }
+
+        // Writer side, under the Space's write lock
+        void append(const Plane* planes, std::size_t n)
+        {
+            if (n == 0) return;
+            // Storage another version already appended to, or full: move to a bigger one
+            if (!storage || storage->size() != count || storage->capacity() - count < n) {
+                auto grown = std::make_shared<std::vector<Plane>>();
+                grown->reserve(std::max(2 * count, count + n));
+                grown->insert(grown->end(), first, first + count);
+                storage = std::move(grown);
+            }
+            storage->insert(storage->end(), planes, planes + n);
+            first = storage->data();
+            count += n;
+        }
+
+        void append(const Plane& plane) { append(&plane, 1); }
+
+        // Replace the whole list; versions holding the old one keep it
+        void assign(std::vector<Plane> planes)
+        {
+            storage = std::make_shared<std::vector<Plane>>(std::move(planes));
+            first = storage->data();
+            count = storage->size();
+        }
+
+    private:
+        std::shared_ptr<std::vector<Plane>> storage;
+        const Plane* first = nullptr;
+        std::size_t count = 0;
+    };
+
+    // Model with several pre-built tessellations; the renderer picks one per frame
+    struct LodObject
+    {
+        Vector3 center;
+        double radius = 0.0;           // bounding sphere of every level
+        std::vector<PlanesPtr> levels; // finest first
+    };
+
+    // Axis-aligned room for portal culling
+    struct Cell
+    {
+        Vector3 boundsMin;
+        Vector3 boundsMax;
+
+        bool contains(const Vector3& p) const
+        {
+            return p.x >= boundsMin.x && p.x <= boundsMax.x &&
+                   p.y >= boundsMin.y && p.y <= boundsMax.y &&
+                   p.z >= boundsMin.z && p.z <= boundsMax.z;
+        }
+
+        bool overlapsSphere(const Vector3& center, double radius) const
+        {
+            const double dx = std::max({boundsMin.x - center.x, 0.0, center.x - boundsMax.x});
+            const double dy = std::max({boundsMin.y - center.y, 0.0, center.y - boundsMax.y});
+            const double dz = std::max({boundsMin.z - center.z, 0.0, center.z - boundsMax.z});
+            return dx * dx + dy * dy + dz * dz <= radius * radius;
+        }
+    };
+
+    // Convex quad opening between two cells, corners in order around the edge
+    struct Portal
+    {
+        int cellA;
+        int cellB;
+        Vector3 corners[4];
+    };
+
+    using LodObjectsPtr = std::shared_ptr<const std::vector<LodObject>>;
+
+    // Planes touching several cells, traced once if any of those cells is visible
+    struct BorderPlanes
+    {
+        std::vector<int> cells;
+        SharedPlanes planes;
+    };
+
+    // Static geometry bucketed by cell, derived by edit() whenever cells exist.
+    // Every plane is in exactly one bucket so no plane is traced twice.
+    struct CellIndex
+    {
+        std::vector<SharedPlanes> cellPlanes;         // planes touching only this cell
+        std::vector<BorderPlanes> borderPlanes;       // grouped by the set of cells touched
+        std::vector<std::vector<int>> cellPortals;    // portals touching each cell
+        std::vector<std::vector<int>> lodObjectCells; // cells each object's sphere overlaps, empty if none
+        SharedPlanes outsidePlanes;                   // planes in no cell, always traced
+
+        void addPlanes(const std::vector<Cell>& cells, const Plane* planes, std::size_t count)
+        {
+            const double EPS = 1e-6;
+
+            std::vector<int> touched;
+            for (std::size_t p = 0; p < count; ++p) {
+                const Plane& plane = planes[p];
+                const Vector3 a = plane.getA(), b = plane.getB(), c = plane.getC();
+                const Vector3 lo(std::min({a.x, b.x, c.x}), std::min({a.y, b.y, c.y}), std::min({a.z, b.z, c.z}));
+                const Vector3 hi(std::max({a.x, b.x, c.x}), std::max({a.y, b.y, c.y}), std::max({a.z, b.z, c.z}));
+
+                touched.clear();
+                for (std::size_t i = 0; i < cells.size(); ++i) {
+                    const Cell& cell = cells[i];
+                    if (hi.x < cell.boundsMin.x - EPS || lo.x > cell.boundsMax.x + EPS) continue;
+                    if (hi.y < cell.boundsMin.y - EPS || lo.y > cell.boundsMax.y + EPS) continue;
+                    if (hi.z < cell.boundsMin.z - EPS || lo.z > cell.boundsMax.z + EPS) continue;
+                    touched.push_back(static_cast<int>(i));
+                }
+
+                if (touched.empty()) {
+                    outsidePlanes.append(plane);
+                } else if (touched.size() == 1) {
+                    cellPlanes[touched[0]].append(plane);
+                } else {
+                    auto group = std::find_if(borderPlanes.begin(), borderPlanes.end(),
+                                              [&](const BorderPlanes& g) { return g.cells == touched; });
+                    if (group == borderPlanes.end()) {
+                        borderPlanes.push_back(BorderPlanes{touched, SharedPlanes()});
+                        group = borderPlanes.end() - 1;
+                    }
+                    group->planes.append(plane);
+                }
+            }
+        }
+
+        void addObjects(const std::vector<Cell>& cells, const LodObject* objects, std::size_t count)
+        {
+            for (std::size_t i = 0; i < count; ++i) {
+                std::vector<int> overlapped;
+                for (std::size_t c = 0; c < cells.size(); ++c) {
+                    if (cells[c].overlapsSphere(objects[i].center, objects[i].radius)) overlapped.push_back(static_cast<int>(c));
+                }
+                lodObjectCells.push_back(std::move(overlapped));
+            }
+        }
+    };
+
+    // One published version. Copying it copies pointers to the geometry,
+    // not the geometry itself.
+    struct Snapshot
+    {
+        SharedPlanes planes;
+        std::vector<ChunkPtr> chunks; // streamed geometry, shared with the loader that owns it
+        LodObjectsPtr lodObjects = std::make_shared<const std::vector<LodObject>>();
+
+        std::vector<Cell> cells;
+        std::vector<Portal> portals;
+
+        // Null while there are no cells
+        std::shared_ptr<const CellIndex> cellIndex;
+
+        // Set by edits that change planes, cells, portals or objects in place;
+        // appends are picked up by edit() on its own
+        bool cellIndexDirty = false;
+
+        // Index of the first cell containing p, -1 if none
+        int findCell(const Vector3& p) const
+        {
+            for (std::size_t i = 0; i < cells.size(); ++i) {
+                if (cells[i].contains(p)) return static_cast<int>(i);
+            }
+            return -1;
+        }
+    };
+
+    using SnapshotPtr = std::shared_ptr<const Snapshot>;
+
+    // Collects planes for scene construction and publishes them as a
+    // single version, instead of one copy-on-write per addPlane().
+    class Builder
+    {
+    public:
+        explicit Builder(Space& space) : space(space) {}
+
+        Builder(const Builder&) = delete;
+        Builder& operator=(const Builder&) = delete;
+
+        // Reserve room for count more planes
+        void reserve(std::size_t count) { added.reserve(added.size() + count); }
+
+        void addPlane(const Plane& plane) { added.push_back(plane); }
+
+        void addLodObject(const LodObject& object) { addedObjects.push_back(object); }
+
+        std::size_t size() const { return added.size(); }
+
+        // Append everything added so far to the space and start over
+        void commit()
+        {
+            if (added.empty() && addedObjects.empty()) return;
+            space.edit([&](Snapshot& next) {
+                next.planes.append(added.data(), added.size());
+                if (!addedObjects.empty()) {
+                    auto objects = std::make_shared<std::vector<LodObject>>(*next.lodObjects);
+                    objects->insert(objects->end(), addedObjects.begin(), addedObjects.end());
+                    next.lodObjects = std::move(objects);
+                }
+            });
+            added.clear();
+            addedObjects.clear();
+        }
+
+    private:
+        Space& space;
+        std::vector<Plane> added;
+        std::vector<LodObject> addedObjects;
+    };
+
+    Space() : current(std::make_shared<const Snapshot>()) {}
+
     void addPlane(const Plane& plane)
     {
-        planes.push_back(plane);
+        edit([&](Snapshot& next) { next.planes.append(plane); });
+    }
+
+    // Apply several changes and publish them as one version.
+    // Appends are indexed automatically; set next.cellIndexDirty when
+    // changing planes, cells, portals or lodObjects in place.
+    template <typename Fn>
+    void edit(Fn&& fn)
+    {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        SnapshotPtr prev = current.load();
+        auto next = std::make_shared<Snapshot>(*prev);
+        fn(*next);
+        updateCellIndex(*prev, *next);
+        current.store(SnapshotPtr(std::move(next)));
+    }
+
+    // Objects are only ever appended, so their index identifies them across versions
+    void addLodObject(const LodObject& object)
+    {
+        edit([&](Snapshot& next) {
+            auto objects = std::make_shared<std::vector<LodObject>>(*next.lodObjects);
+            objects->push_back(object);
+            next.lodObjects = std::move(objects);
+        });
     }
 
-    const std::vector<Plane>& getPlanes() const { return planes; }
+    // Describe a room for portal culling; returns its index
+    int addCell(const Vector3& boundsMin, const Vector3& boundsMax)
+    {
+        int index = 0;
+        edit([&](Snapshot& next) {
+            index = static_cast<int>(next.cells.size());
+            next.cells.push_back(Cell{boundsMin, boundsMax});
+        });
+        return index;
+    }
+
+    // Connect two cells through a convex quad opening
+    void addPortal(int cellA, int cellB, const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& d)
+    {
+        edit([&](Snapshot& next) {
+            next.portals.push_back(Portal{cellA, cellB, {a, b, c, d}});
+        });
+    }
+
+    // Replace the set of streamed chunks; chunk data itself is not copied
+    void setChunks(std::vector<ChunkPtr> chunks)
+    {
+        edit([&](Snapshot& next) { next.chunks = std::move(chunks); });
+    }
+
+    // Pin the latest published version; it stays valid while the pointer is held
+    SnapshotPtr snapshot() const { return current.load(); }
 
 private:
-    std::vector<Plane> planes;
+    // Keep the cell index in step with next: rebuilt when cells, portals or
+    // in-place data changed, extended when planes or objects were appended,
+    // and left alone for chunk-only edits
+    static void updateCellIndex(const Snapshot& prev, Snapshot& next)
+    {
+        const bool dirty = next.cellIndexDirty;
+        next.cellIndexDirty = false;
+        if (next.cells.empty()) {
+            next.cellIndex.reset();
+            return;
+        }
+
+        const std::vector<LodObject>& objects = *next.lodObjects;
+        const bool rebuild = dirty || !next.cellIndex ||
+            next.cells.size() != prev.cells.size() ||
+            next.portals.size() != prev.portals.size() ||
+            next.planes.size() < prev.planes.size() ||
+            objects.size() < prev.lodObjects->size();
+
+        if (rebuild) {
+            auto index = std::make_shared<CellIndex>();
+            index->cellPlanes.resize(next.cells.size());
+            index->cellPortals.resize(next.cells.size());
+            const int cellCount = static_cast<int>(next.cells.size());
+            for (std::size_t i = 0; i < next.portals.size(); ++i) {
+                const Portal& portal = next.portals[i];
+                if (portal.cellA < 0 || portal.cellA >= cellCount || portal.cellB < 0 || portal.cellB >= cellCount) continue;
+                index->cellPortals[portal.cellA].push_back(static_cast<int>(i));
+                index->cellPortals[portal.cellB].push_back(static_cast<int>(i));
+            }
+            index->addPlanes(next.cells, next.planes.data(), next.planes.size());
+            index->addObjects(next.cells, objects.data(), objects.size());
+            next.cellIndex = std::move(index);
+            return;
+        }
+
+        const std::size_t oldPlanes = prev.planes.size();
+        const std::size_t oldObjects = prev.lodObjects->size();
+        if (next.planes.size() == oldPlanes && objects.size() == oldObjects) return;
+
+        auto index = std::make_shared<CellIndex>(*next.cellIndex);
+        index->addPlanes(next.cells, next.planes.data() + oldPlanes, next.planes.size() - oldPlanes);
+        index->addObjects(next.cells, objects.data() + oldObjects, objects.size() - oldObjects);
+        next.cellIndex = std::move(index);
+    }
+
+    RcuPointer<Snapshot> current;
+    std::mutex writeMutex; // serializes writers only, readers never take it
 };
 
 #endif
\ No newline at end of file
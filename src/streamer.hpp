@@ -0,0 +1,433 @@
+#ifndef STREAMER_HPP
+#define STREAMER_HPP
+
+#include "viewpoint.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Out-of-core world split into square chunks on the XZ grid.
+// Chunks are baked to disk once with bake(); at runtime update() is called
+// every frame with the viewpoint, background threads load nearby chunks in
+// view and the least recently used ones are dropped to stay under budget.
+// The resident set is published into a Space, so a chunk that has not
+// arrived yet is simply not traced and the frame never waits on disk.
+class WorldStreamer
+{
+public:
+    struct Settings
+    {
+        double loadRadius = 80.0;                  // chunks farther than this are never requested
+        double keepRadius = 16.0;                  // chunks closer than this load even when behind the camera
+        std::size_t memoryBudget = 64u << 20;      // bytes of resident plane data
+        unsigned int ioThreads = 2;
+        double retryDelay = 1.0;                   // seconds before a failed chunk is retried, doubling per failure
+    };
+
+    WorldStreamer(Space& space, const std::string& directory)
+        : WorldStreamer(space, directory, Settings())
+    {
+    }
+
+    WorldStreamer(Space& space, const std::string& directory, const Settings& settings)
+        : space(space), directory(directory), settings(settings)
+    {
+    }
+
+    ~WorldStreamer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            stopping = true;
+        }
+        queueCv.notify_all();
+        for (auto& t : workers) {
+            t.join();
+        }
+    }
+
+    WorldStreamer(const WorldStreamer&) = delete;
+    WorldStreamer& operator=(const WorldStreamer&) = delete;
+
+    // Split planes into chunks by centroid and write them to directory
+    static bool bake(const std::vector<Plane>& planes, double chunkSize, const std::string& directory)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        if (ec) return false;
+
+        std::map<std::pair<int, int>, std::vector<Plane>> buckets;
+        for (const auto& plane : planes) {
+            Vector3 centroid = (plane.getA() + plane.getB() + plane.getC()) * (1.0 / 3.0);
+            int cx = static_cast<int>(std::floor(centroid.x / chunkSize));
+            int cz = static_cast<int>(std::floor(centroid.z / chunkSize));
+            buckets[{cx, cz}].push_back(plane);
+        }
+
+        std::ofstream index(indexPath(directory), std::ios::binary);
+        if (!index) return false;
+
+        uint32_t magic = indexMagic;
+        uint64_t count = buckets.size();
+        writeRaw(index, magic);
+        writeRaw(index, chunkSize);
+        writeRaw(index, count);
+
+        for (const auto& bucket : buckets) {
+            ChunkInfo info;
+            info.cx = bucket.first.first;
+            info.cz = bucket.first.second;
+            info.planeCount = bucket.second.size();
+            const double inf = std::numeric_limits<double>::infinity();
+            info.boundsMin = Vector3(inf, inf, inf);
+            info.boundsMax = Vector3(-inf, -inf, -inf);
+            for (const auto& plane : bucket.second) {
+                for (const Vector3& v : {plane.getA(), plane.getB(), plane.getC()}) {
+                    info.boundsMin = Vector3(std::min(info.boundsMin.x, v.x), std::min(info.boundsMin.y, v.y), std::min(info.boundsMin.z, v.z));
+                    info.boundsMax = Vector3(std::max(info.boundsMax.x, v.x), std::max(info.boundsMax.y, v.y), std::max(info.boundsMax.z, v.z));
+                }
+            }
+
+            writeRaw(index, info.cx);
+            writeRaw(index, info.cz);
+            writeRaw(index, info.planeCount);
+            writeVector(index, info.boundsMin);
+            writeVector(index, info.boundsMax);
+
+            std::ofstream chunk(chunkPath(directory, info.cx, info.cz), std::ios::binary);
+            if (!chunk) return false;
+            for (const auto& plane : bucket.second) {
+                writeVector(chunk, plane.getA());
+                writeVector(chunk, plane.getB());
+                writeVector(chunk, plane.getC());
+            }
+            if (!chunk) return false;
+        }
+
+        return static_cast<bool>(index);
+    }
+
+    // Read the chunk index and start the I/O threads
+    bool open()
+    {
+        std::ifstream index(indexPath(directory), std::ios::binary);
+        if (!index) return false;
+
+        uint32_t magic = 0;
+        uint64_t count = 0;
+        readRaw(index, magic);
+        readRaw(index, chunkSize);
+        readRaw(index, count);
+        if (!index || magic != indexMagic || chunkSize <= 0.0) return false;
+
+        for (uint64_t i = 0; i < count; ++i) {
+            ChunkEntry entry;
+            readRaw(index, entry.info.cx);
+            readRaw(index, entry.info.cz);
+            readRaw(index, entry.info.planeCount);
+            readVector(index, entry.info.boundsMin);
+            readVector(index, entry.info.boundsMax);
+            if (!index) return false;
+            chunks.emplace(key(entry.info.cx, entry.info.cz), std::move(entry));
+        }
+
+        unsigned int numThreads = std::max(1u, settings.ioThreads);
+        for (unsigned int i = 0; i < numThreads; ++i) {
+            workers.emplace_back([this]() { ioLoop(); });
+        }
+        return true;
+    }
+
+    // Schedule loads around the viewpoint, take in finished ones and evict over budget.
+    // Never blocks on I/O; call once per frame from the thread driving the viewpoint.
+    void update(const Viewpoint& viewpoint)
+    {
+        ++frame;
+
+        const Vector3 pos = viewpoint.getPosition();
+        const double yawRad = viewpoint.getYaw() * M_PI / 180.0;
+        const double pitchRad = viewpoint.getPitch() * M_PI / 180.0;
+        const Vector3 forward = Vector3(
+            std::cos(pitchRad) * std::cos(yawRad),
+            std::sin(pitchRad),
+            std::cos(pitchRad) * std::sin(yawRad)
+        ).normalize();
+
+        // half angle of the cone around the screen diagonal
+        const double aspect = static_cast<double>(viewpoint.getScreenWidth()) / viewpoint.getScreenHeight();
+        const double tanHalfFov = std::tan(viewpoint.getFOV() * M_PI / 360.0);
+        const double halfDiagonal = std::atan(tanHalfFov * std::sqrt(1.0 + aspect * aspect));
+
+        // collect wanted chunks from the grid cells within loadRadius,
+        // one extra ring for planes that stick out of their cell
+        wanted.clear();
+        const int reach = static_cast<int>(std::ceil(settings.loadRadius / chunkSize)) + 1;
+        const int ccx = static_cast<int>(std::floor(pos.x / chunkSize));
+        const int ccz = static_cast<int>(std::floor(pos.z / chunkSize));
+        for (int cx = ccx - reach; cx <= ccx + reach; ++cx) {
+            for (int cz = ccz - reach; cz <= ccz + reach; ++cz) {
+                auto it = chunks.find(key(cx, cz));
+                if (it == chunks.end()) continue;
+
+                ChunkEntry& entry = it->second;
+                double distance = boxDistance(pos, entry.info);
+                if (distance > settings.loadRadius) continue;
+                if (distance > settings.keepRadius && !inView(pos, forward, halfDiagonal, entry.info)) continue;
+
+                wanted.emplace_back(distance, &entry);
+            }
+        }
+        std::sort(wanted.begin(), wanted.end(),
+            [](const auto& l, const auto& r) { return l.first < r.first; });
+
+        const auto now = std::chrono::steady_clock::now();
+        bool changed = false;
+        bool wake = false;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+
+            // take in finished loads
+            for (auto& done : completed) {
+                inFlight.erase(done.first);
+                auto it = chunks.find(done.first);
+                if (it == chunks.end()) continue;
+
+                ChunkEntry& entry = it->second;
+                if (!done.second) {
+                    // back off before asking again, so a transient error does not leave a permanent hole
+                    double delay = settings.retryDelay * static_cast<double>(1u << std::min(entry.failures, 5u));
+                    entry.retryAt = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(delay));
+                    ++entry.failures;
+                    continue;
+                }
+                entry.failures = 0;
+                entry.planes = std::move(done.second);
+                entry.lastUsed = frame;
+                lru.push_front(done.first);
+                entry.lruPos = lru.begin();
+                residentBytes += chunkBytes(entry.info);
+                changed = true;
+            }
+            completed.clear();
+
+            // nearest first, as long as the working set fits in the budget;
+            // loads in flight are already counted
+            std::size_t committed = 0;
+            for (const auto& item : inFlight) {
+                committed += item.second;
+            }
+            pending.clear();
+            for (const auto& w : wanted) {
+                ChunkEntry& entry = *w.second;
+                uint64_t k = key(entry.info.cx, entry.info.cz);
+                if (inFlight.find(k) != inFlight.end()) continue;
+
+                std::size_t bytes = chunkBytes(entry.info);
+                if (committed + bytes > settings.memoryBudget) break;
+                committed += bytes;
+
+                if (entry.planes) {
+                    touch(entry);
+                } else if (now >= entry.retryAt) {
+                    pending.push_back(k);
+                }
+            }
+            wake = !pending.empty();
+        }
+        if (wake) queueCv.notify_all();
+
+        // evict least recently used chunks not needed this frame
+        while (residentBytes > settings.memoryBudget && !lru.empty()) {
+            ChunkEntry& entry = chunks.at(lru.back());
+            if (entry.lastUsed == frame) break;
+            residentBytes -= chunkBytes(entry.info);
+            entry.planes.reset();
+            lru.pop_back();
+            changed = true;
+        }
+
+        if (changed) {
+            std::vector<Space::ChunkPtr> resident;
+            resident.reserve(lru.size());
+            for (uint64_t k : lru) {
+                resident.push_back(chunks.at(k).planes);
+            }
+            space.setChunks(std::move(resident));
+        }
+    }
+
+    std::size_t getResidentBytes() const { return residentBytes; }
+    std::size_t getResidentChunks() const { return lru.size(); }
+    std::size_t getChunkCount() const { return chunks.size(); }
+
+private:
+    struct ChunkInfo
+    {
+        int32_t cx = 0;
+        int32_t cz = 0;
+        uint64_t planeCount = 0;
+        Vector3 boundsMin;
+        Vector3 boundsMax;
+    };
+
+    struct ChunkEntry
+    {
+        ChunkInfo info;
+        Space::ChunkPtr planes; // null while not resident
+        uint64_t lastUsed = 0;
+        std::list<uint64_t>::iterator lruPos;
+        unsigned int failures = 0; // consecutive failed loads
+        std::chrono::steady_clock::time_point retryAt;
+    };
+
+    static constexpr uint32_t indexMagic = 0x4B4E4843; // "CHNK"
+
+    static uint64_t key(int cx, int cz)
+    {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) | static_cast<uint32_t>(cz);
+    }
+
+    static std::size_t chunkBytes(const ChunkInfo& info)
+    {
+        return static_cast<std::size_t>(info.planeCount) * sizeof(Plane);
+    }
+
+    static std::string indexPath(const std::string& dir)
+    {
+        return dir + "/index.bin";
+    }
+
+    static std::string chunkPath(const std::string& dir, int cx, int cz)
+    {
+        return dir + "/chunk_" + std::to_string(cx) + "_" + std::to_string(cz) + ".bin";
+    }
+
+    template <typename T>
+    static void writeRaw(std::ostream& out, const T& value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    static void readRaw(std::istream& in, T& value)
+    {
+        in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    }
+
+    static void writeVector(std::ostream& out, const Vector3& v)
+    {
+        writeRaw(out, v.x);
+        writeRaw(out, v.y);
+        writeRaw(out, v.z);
+    }
+
+    static void readVector(std::istream& in, Vector3& v)
+    {
+        readRaw(in, v.x);
+        readRaw(in, v.y);
+        readRaw(in, v.z);
+    }
+
+    static double boxDistance(const Vector3& p, const ChunkInfo& info)
+    {
+        double dx = std::max({info.boundsMin.x - p.x, 0.0, p.x - info.boundsMax.x});
+        double dy = std::max({info.boundsMin.y - p.y, 0.0, p.y - info.boundsMax.y});
+        double dz = std::max({info.boundsMin.z - p.z, 0.0, p.z - info.boundsMax.z});
+        return std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+
+    // Conservative test of the chunk's bounding sphere against the view cone
+    static bool inView(const Vector3& pos, const Vector3& forward, double halfAngle, const ChunkInfo& info)
+    {
+        Vector3 center = (info.boundsMin + info.boundsMax) * 0.5;
+        double radius = (info.boundsMax - info.boundsMin).magnitude() * 0.5;
+        Vector3 toCenter = center - pos;
+        double distance = toCenter.magnitude();
+        if (distance <= radius) return true;
+
+        double angle = std::acos(std::max(-1.0, std::min(1.0, toCenter.dot(forward) / distance)));
+        return angle - std::asin(radius / distance) <= halfAngle;
+    }
+
+    void touch(ChunkEntry& entry)
+    {
+        entry.lastUsed = frame;
+        lru.splice(lru.begin(), lru, entry.lruPos);
+    }
+
+    static Space::ChunkPtr loadChunk(const std::string& path, uint64_t planeCount)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return nullptr;
+
+        auto planes = std::make_shared<std::vector<Plane>>();
+        planes->reserve(planeCount);
+        for (uint64_t i = 0; i < planeCount; ++i) {
+            Vector3 a, b, c;
+            readVector(in, a);
+            readVector(in, b);
+            readVector(in, c);
+            if (!in) return nullptr;
+            planes->emplace_back(a, b, c);
+        }
+        return planes;
+    }
+
+    void ioLoop()
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        while (true) {
+            queueCv.wait(lock, [this]() { return stopping || !pending.empty(); });
+            if (stopping) return;
+
+            // pending is sorted nearest first
+            uint64_t k = pending.front();
+            pending.erase(pending.begin());
+
+            const ChunkInfo info = chunks.at(k).info;
+            inFlight.emplace(k, chunkBytes(info));
+
+            lock.unlock();
+            Space::ChunkPtr planes = loadChunk(chunkPath(directory, info.cx, info.cz), info.planeCount);
+            lock.lock();
+
+            completed.emplace_back(k, std::move(planes));
+        }
+    }
+
+    Space& space;
+    std::string directory;
+    Settings settings;
+    double chunkSize = 0.0;
+
+    // owned by the thread calling update(); I/O threads only read ChunkInfo
+    std::unordered_map<uint64_t, ChunkEntry> chunks;
+    std::list<uint64_t> lru; // resident chunks, most recently used first
+    std::size_t residentBytes = 0;
+    uint64_t frame = 0;
+    std::vector<std::pair<double, ChunkEntry*>> wanted; // reused across updates
+
+    // shared with the I/O threads, guarded by queueMutex
+    std::mutex queueMutex;
+    std::condition_variable queueCv;
+    std::vector<uint64_t> pending;
+    std::unordered_map<uint64_t, std::size_t> inFlight;
+    std::vector<std::pair<uint64_t, Space::ChunkPtr>> completed;
+    bool stopping = false;
+
+    std::vector<std::thread> workers;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,57 @@
+#ifndef ALLOC_COUNTER_HPP
+#define ALLOC_COUNTER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// Process-wide count of global operator new calls, used to check that
+// steady-state frames do not touch the heap. The counting operators are
+// only compiled where ALLOC_COUNTER_IMPLEMENTATION is defined before the
+// include, which must be exactly one translation unit (main.cpp).
+namespace alloc_counter
+{
+    inline std::atomic<uint64_t> allocations{0};
+
+    inline uint64_t count() { return allocations.load(std::memory_order_relaxed); }
+}
+
+#ifdef ALLOC_COUNTER_IMPLEMENTATION
+
+void* operator new(std::size_t size)
+{
+    alloc_counter::allocations.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0) size = 1;
+    if (void* p = std::malloc(size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+#endif
+
+#endif
\ No newline at end of file
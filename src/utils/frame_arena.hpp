@@ -0,0 +1,88 @@
+#ifndef FRAME_ARENA_HPP
+#define FRAME_ARENA_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for data that lives for one frame.
+// allocate() hands out memory from a single block and reset() rewinds it.
+// If a frame needs more than the block holds, overflow blocks are taken
+// from the heap and the next reset() merges them into one bigger block,
+// so once the working set stops growing frames allocate nothing.
+class FrameArena
+{
+public:
+    explicit FrameArena(std::size_t initialBytes = 64 * 1024)
+        : capacity(initialBytes), block(new unsigned char[initialBytes])
+    {
+    }
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Only trivially destructible types; nothing is destroyed on reset()
+    template <typename T>
+    T* allocate(std::size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "FrameArena does not run destructors");
+        return static_cast<T*>(allocateBytes(count * sizeof(T), alignof(T)));
+    }
+
+    void reset()
+    {
+        if (!overflow.empty()) {
+            std::size_t total = capacity;
+            for (const auto& extra : overflow) {
+                total += extra.size;
+            }
+            overflow.clear();
+            block.reset(new unsigned char[total]);
+            capacity = total;
+        }
+        used = 0;
+    }
+
+    std::size_t getCapacity() const { return capacity; }
+
+private:
+    struct Overflow
+    {
+        std::unique_ptr<unsigned char[]> data;
+        std::size_t size;
+        std::size_t used;
+    };
+
+    void* allocateBytes(std::size_t bytes, std::size_t align)
+    {
+        std::size_t offset = (used + align - 1) & ~(align - 1);
+        if (offset + bytes <= capacity) {
+            used = offset + bytes;
+            return block.get() + offset;
+        }
+
+        if (!overflow.empty()) {
+            Overflow& tail = overflow.back();
+            std::size_t tailOffset = (tail.used + align - 1) & ~(align - 1);
+            if (tailOffset + bytes <= tail.size) {
+                tail.used = tailOffset + bytes;
+                return tail.data.get() + tailOffset;
+            }
+        }
+
+        // new[] storage is aligned for any fundamental type
+        std::size_t size = std::max(bytes, capacity);
+        overflow.push_back(Overflow{std::unique_ptr<unsigned char[]>(new unsigned char[size]), size, bytes});
+        return overflow.back().data.get();
+    }
+
+    std::size_t capacity;
+    std::size_t used = 0;
+    std::unique_ptr<unsigned char[]> block;
+    std::vector<Overflow> overflow;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,106 @@
+#ifndef RCU_POINTER_HPP
+#define RCU_POINTER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Lock-free publication of a shared_ptr<const T>: any number of readers,
+// one writer at a time. The published pointer lives in a small node; a
+// reader announces the node in a hazard slot, checks it is still current
+// and copies the shared_ptr out, so neither side ever takes a lock.
+// Replaced nodes are deleted by later store()s once no slot names them,
+// and the values themselves go away when their last reader lets go.
+// (std::atomic_load on shared_ptr is not lock-free in libstdc++: it
+// hashes into a global table of mutexes shared by every such pointer.)
+template <typename T>
+class RcuPointer
+{
+public:
+    using Ptr = std::shared_ptr<const T>;
+
+    explicit RcuPointer(Ptr initial)
+        : current(new Node{std::move(initial)})
+    {
+        for (auto& slot : slots) {
+            slot.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    // No reader may still be inside load()
+    ~RcuPointer()
+    {
+        delete current.load(std::memory_order_relaxed);
+        for (const Node* node : retired) {
+            delete node;
+        }
+    }
+
+    RcuPointer(const RcuPointer&) = delete;
+    RcuPointer& operator=(const RcuPointer&) = delete;
+
+    // Any thread; does not allocate or block
+    Ptr load() const
+    {
+        std::atomic<const Node*>& slot = claimSlot();
+
+        const Node* node = current.load(std::memory_order_seq_cst);
+        while (true) {
+            slot.store(node, std::memory_order_seq_cst);
+            const Node* again = current.load(std::memory_order_seq_cst);
+            if (again == node) break;
+            node = again;
+        }
+
+        Ptr value = node->value;
+        slot.store(nullptr, std::memory_order_release);
+        return value;
+    }
+
+    // Callers serialize writers themselves
+    void store(Ptr value)
+    {
+        const Node* old = current.exchange(new Node{std::move(value)}, std::memory_order_seq_cst);
+        retired.push_back(old);
+
+        retired.erase(std::remove_if(retired.begin(), retired.end(), [this](const Node* node) {
+            for (const auto& slot : slots) {
+                if (slot.load(std::memory_order_seq_cst) == node) return false;
+            }
+            delete node;
+            return true;
+        }), retired.end());
+    }
+
+private:
+    struct Node
+    {
+        Ptr value;
+    };
+
+    // Slots are only held for a pointer copy, so a few dozen cover any
+    // number of readers; a reader finding all of them busy retries.
+    static constexpr std::size_t slotCount = 64;
+
+    std::atomic<const Node*>& claimSlot() const
+    {
+        static const Node claimed{};
+        while (true) {
+            for (auto& slot : slots) {
+                const Node* expected = nullptr;
+                if (slot.load(std::memory_order_relaxed) == nullptr &&
+                    slot.compare_exchange_strong(expected, &claimed, std::memory_order_acquire)) {
+                    return slot;
+                }
+            }
+        }
+    }
+
+    std::atomic<const Node*> current;
+    mutable std::atomic<const Node*> slots[slotCount];
+    std::vector<const Node*> retired; // writer only
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef TRIPLE_BUFFER_HPP
+#define TRIPLE_BUFFER_HPP
+
+#include <atomic>
+
+// Lock-free single producer / single consumer hand-off of the latest value.
+// The writer fills writeBuffer() and publish()es it; the reader calls
+// update() to swap in the newest published buffer, skipping stale ones.
+// Neither side ever waits for the other.
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() : TripleBuffer(T()) {}
+
+    explicit TripleBuffer(const T& initial)
+        : buffers{initial, initial, initial}
+    {
+    }
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Writer side
+    T& writeBuffer() { return buffers[writeIndex]; }
+
+    void publish()
+    {
+        writeIndex = middle.exchange(writeIndex | dirtyBit, std::memory_order_acq_rel) & indexMask;
+    }
+
+    // Reader side; returns true if a newer buffer was swapped in
+    bool update()
+    {
+        if (!(middle.load(std::memory_order_relaxed) & dirtyBit)) return false;
+        readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+
+    const T& readBuffer() const { return buffers[readIndex]; }
+
+private:
+    static constexpr unsigned int indexMask = 3;
+    static constexpr unsigned int dirtyBit = 4;
+
+    T buffers[3];
+    std::atomic<unsigned int> middle{1};
+    unsigned int writeIndex = 0;
+    unsigned int readIndex = 2;
+};
+
+#endif
\ No newline at end of file
@@ -2,18 +2,26 @@
 #define UTILS_LOOP_HPP
 
 #include "../viewpoint.hpp"
+#include "alloc_counter.hpp"
 #include <SDL2/SDL.h>
 #include <iostream>
 #include <cmath>
+#include <atomic>
+#include <functional>
+#include <thread>
 
-// Run a main interaction loop
-inline void runInteractionLoop(Viewpoint& viewpoint) {
+// Run a main interaction loop.
+// This thread polls input, integrates the camera by elapsed time and presents
+// finished frames; tracing runs on its own render thread, which latches the
+// newest pose at the start of every frame. onFrame runs on this thread after
+// each presented frame.
+inline void runInteractionLoop(Viewpoint& viewpoint, const std::function<void(Viewpoint&)>& onFrame = nullptr) {
     if (!viewpoint.initSDL()) {
         std::cerr << "Failed to initialize SDL!" << std::endl;
         return;
     }
 
-    bool running = true;
+    std::atomic<bool> running(true);
     SDL_Event event;
     bool mouseCaptured = true;
     
@@ -28,16 +36,37 @@ inline void runInteractionLoop(Viewpoint& viewpoint) {
     SDL_SetRelativeMouseMode(SDL_TRUE);
     SDL_ShowCursor(SDL_DISABLE);
     
-    const double moveSpeed = 0.1;
-    const double rotateSpeed = 2.0;
+    const double moveSpeed = 3.0; // units per second
+    const double rotateSpeed = 90.0; // degrees per second
     const double mouseSensitivity = 0.2;
+    const double maxStep = 0.1; // ignore longer stalls instead of jumping
     
     // FPS counter
     Uint32 frameCount = 0;
     Uint32 lastFpsTime = SDL_GetTicks();
     double fps = 0.0;
 
+    // frames traced by the render thread, which presented frames may skip
+    std::atomic<uint64_t> renderedFrames(0);
+    std::thread renderThread([&]() {
+        while (running.load(std::memory_order_relaxed)) {
+            viewpoint.renderFrame();
+            renderedFrames.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    uint64_t lastAllocations = alloc_counter::count();
+    uint64_t lastRendered = renderedFrames.load(std::memory_order_relaxed);
+
+    const double counterFrequency = static_cast<double>(SDL_GetPerformanceFrequency());
+    Uint64 lastCounter = SDL_GetPerformanceCounter();
+
     while (running) {
+        Uint64 counter = SDL_GetPerformanceCounter();
+        double dt = std::min((counter - lastCounter) / counterFrequency, maxStep);
+        lastCounter = counter;
+
+        CameraPose pose = viewpoint.getPose();
+
         const Uint8* keyState = SDL_GetKeyboardState(NULL);
         bool altPressed = keyState[SDL_SCANCODE_LALT] || keyState[SDL_SCANCODE_RALT];
         
@@ -62,71 +91,81 @@ inline void runInteractionLoop(Viewpoint& viewpoint) {
             if (event.type == SDL_MOUSEMOTION && mouseCaptured) {
                 double yawDelta = -event.motion.xrel * mouseSensitivity;
                 double pitchDelta = event.motion.yrel * mouseSensitivity;
-                viewpoint.setYaw(viewpoint.getYaw() + yawDelta);
-                viewpoint.setPitch(viewpoint.getPitch() + pitchDelta);
+                pose.yaw += yawDelta;
+                pose.pitch += pitchDelta;
                 
                 // clamp pitch
-                if (viewpoint.getPitch() > 89.0) viewpoint.setPitch(89.0);
-                if (viewpoint.getPitch() < -89.0) viewpoint.setPitch(-89.0);
+                if (pose.pitch > 89.0) pose.pitch = 89.0;
+                if (pose.pitch < -89.0) pose.pitch = -89.0;
             }
         }
         
         // calculate movement direction
-        Vector3 pos = viewpoint.getPosition();
-        double yaw = viewpoint.getYaw();
-        double yawRad = yaw * M_PI / 180.0;
+        Vector3& pos = pose.position;
+        double yawRad = pose.yaw * M_PI / 180.0;
+        double step = moveSpeed * dt;
+        double turn = rotateSpeed * dt;
         
         if (keyState[SDL_SCANCODE_W]) {
-            pos.x += moveSpeed * std::cos(yawRad);
-            pos.z += moveSpeed * std::sin(yawRad);
+            pos.x += step * std::cos(yawRad);
+            pos.z += step * std::sin(yawRad);
         }
         if (keyState[SDL_SCANCODE_S]) {
-            pos.x -= moveSpeed * std::cos(yawRad);
-            pos.z -= moveSpeed * std::sin(yawRad);
+            pos.x -= step * std::cos(yawRad);
+            pos.z -= step * std::sin(yawRad);
         }
         if (keyState[SDL_SCANCODE_A]) {
-            pos.x += moveSpeed * std::sin(yawRad);
-            pos.z -= moveSpeed * std::cos(yawRad);
+            pos.x += step * std::sin(yawRad);
+            pos.z -= step * std::cos(yawRad);
         }
         if (keyState[SDL_SCANCODE_D]) {
-            pos.x -= moveSpeed * std::sin(yawRad);
-            pos.z += moveSpeed * std::cos(yawRad);
+            pos.x -= step * std::sin(yawRad);
+            pos.z += step * std::cos(yawRad);
         }
         if (keyState[SDL_SCANCODE_LSHIFT] || keyState[SDL_SCANCODE_RSHIFT]) {
-            pos.y += moveSpeed;
+            pos.y += step;
         }
         if (keyState[SDL_SCANCODE_LCTRL] || keyState[SDL_SCANCODE_RCTRL]) {
-            pos.y -= moveSpeed;
+            pos.y -= step;
         }
         
         if (keyState[SDL_SCANCODE_LEFT]) {
-            viewpoint.setYaw(viewpoint.getYaw() - rotateSpeed);
+            pose.yaw -= turn;
         }
         if (keyState[SDL_SCANCODE_RIGHT]) {
-            viewpoint.setYaw(viewpoint.getYaw() + rotateSpeed);
+            pose.yaw += turn;
         }
         if (keyState[SDL_SCANCODE_UP]) {
-            double newPitch = viewpoint.getPitch() + rotateSpeed;
-            if (newPitch > 89.0) newPitch = 89.0;
-            viewpoint.setPitch(newPitch);
+            pose.pitch = std::min(pose.pitch + turn, 89.0);
         }
         if (keyState[SDL_SCANCODE_DOWN]) {
-            double newPitch = viewpoint.getPitch() - rotateSpeed;
-            if (newPitch < -89.0) newPitch = -89.0;
-            viewpoint.setPitch(newPitch);
+            pose.pitch = std::max(pose.pitch - turn, -89.0);
         }
         
-        viewpoint.setPosition(pos);
+        // hand the pose to the renderer in one publish
+        viewpoint.setPose(pose);
+        
+        // show the newest frame, or sleep briefly so input keeps sampling at ~1 kHz
+        if (!viewpoint.present()) {
+            SDL_Delay(1);
+            continue;
+        }
         
-        // render scene
-        viewpoint.render();
+        if (onFrame) onFrame(viewpoint);
         
         // FPS calculation
         frameCount++;
         Uint32 currentTime = SDL_GetTicks();
         if (currentTime - lastFpsTime >= 1000) {
             fps = frameCount * 1000.0 / (currentTime - lastFpsTime);
-            std::cout << "FPS: " << fps << std::endl;
+            uint64_t allocations = alloc_counter::count();
+            uint64_t rendered = renderedFrames.load(std::memory_order_relaxed);
+            uint64_t traced = std::max<uint64_t>(rendered - lastRendered, 1);
+            std::cout << "FPS: " << fps << "  heap allocs/frame: "
+                      << static_cast<double>(allocations - lastAllocations) / traced
+                      << "  planes: " << viewpoint.getTracedPlanes() << std::endl;
+            lastAllocations = allocations;
+            lastRendered = rendered;
             frameCount = 0;
             lastFpsTime = currentTime;
         }
@@ -134,6 +173,8 @@ inline void runInteractionLoop(Viewpoint& viewpoint) {
         // SDL_Delay(16); // ~60 FPS
     }
 
+    renderThread.join();
+
     SDL_SetRelativeMouseMode(SDL_FALSE);
     std::cout << "Exiting..." << std::endl;
 }
@@ -2,8 +2,22 @@
 #define UTILS_MODELS_HPP
 
 #include "space.hpp"
+#include <algorithm>
+#include <cmath>
+#include <memory>
 
-void addCube(Space& space, const Vector3& center, double size)
+// Model helpers write into anything with addPlane(): a Space or a Space::Builder
+
+// Plain plane list target, used to build LOD levels
+struct PlaneList
+{
+    std::vector<Plane> planes;
+
+    void addPlane(const Plane& plane) { planes.push_back(plane); }
+};
+
+template <typename Target>
+void addCube(Target& space, const Vector3& center, double size)
 {
     double half = size / 2.0;
 
@@ -40,7 +54,8 @@ void addCube(Space& space, const Vector3& center, double size)
     space.addPlane(Plane(v4, v5, v1));
     space.addPlane(Plane(v4, v1, v0));
 }
-void addCube(Space& space, const Vector3& pointA, const Vector3& pointB)
+template <typename Target>
+void addCube(Target& space, const Vector3& pointA, const Vector3& pointB)
 {
     Vector3 v0(pointA.x, pointA.y, pointA.z);
     Vector3 v1(pointB.x, pointA.y, pointA.z);
@@ -76,7 +91,8 @@ void addCube(Space& space, const Vector3& pointA, const Vector3& pointB)
     space.addPlane(Plane(v4, v1, v0));
 }
 
-void addBall(Space& space, const Vector3& center, double radius, int segments = 12, int rings = 12)
+template <typename Target>
+void addBall(Target& space, const Vector3& center, double radius, int segments = 12, int rings = 12)
 {
     for (int i = 0; i < rings; ++i) {
         double theta1 = M_PI * i / rings;
@@ -113,7 +129,8 @@ void addBall(Space& space, const Vector3& center, double radius, int segments =
     }
 }
 
-void addCylinder(Space& space, const Vector3& center, double radius, double height, int segments = 12)
+template <typename Target>
+void addCylinder(Target& space, const Vector3& center, double radius, double height, int segments = 12)
 {
     double halfHeight = height / 2.0;
 
@@ -161,4 +178,45 @@ void addCylinder(Space& space, const Vector3& center, double radius, double heig
         ));
     }
 }
+
+// Register a ball as a LOD object; each level halves segments and rings
+template <typename Target>
+void addBallLod(Target& space, const Vector3& center, double radius, int segments = 24, int rings = 24, int levels = 3)
+{
+    Space::LodObject object;
+    object.center = center;
+    object.radius = radius;
+
+    for (int i = 0; i < levels; ++i) {
+        PlaneList level;
+        addBall(level, center, radius, segments, rings);
+        object.levels.push_back(std::make_shared<const std::vector<Plane>>(std::move(level.planes)));
+
+        if (segments == 3 && rings == 2) break;
+        segments = std::max(3, segments / 2);
+        rings = std::max(2, rings / 2);
+    }
+
+    space.addLodObject(object);
+}
+
+// Register a cylinder as a LOD object; each level halves segments
+template <typename Target>
+void addCylinderLod(Target& space, const Vector3& center, double radius, double height, int segments = 24, int levels = 3)
+{
+    Space::LodObject object;
+    object.center = center;
+    object.radius = std::sqrt(radius * radius + height * height / 4.0);
+
+    for (int i = 0; i < levels; ++i) {
+        PlaneList level;
+        addCylinder(level, center, radius, height, segments);
+        object.levels.push_back(std::make_shared<const std::vector<Plane>>(std::move(level.planes)));
+
+        if (segments == 3) break;
+        segments = std::max(3, segments / 2);
+    }
+
+    space.addLodObject(object);
+}
 #endif
\ No newline at end of file
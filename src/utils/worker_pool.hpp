@@ -0,0 +1,107 @@
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads that run one job at a time, fanned out by index.
+// Threads are started once; run() only signals them, so dispatching a
+// frame does not allocate or create shared states like std::async does.
+class WorkerPool
+{
+public:
+    // numThreads counts the calling thread; 0 picks hardware_concurrency()
+    explicit WorkerPool(unsigned int numThreads = 0)
+    {
+        if (numThreads == 0) numThreads = std::thread::hardware_concurrency();
+        if (numThreads == 0) numThreads = 4;
+
+        workerCount = numThreads;
+        threads.reserve(numThreads - 1);
+        for (unsigned int i = 1; i < numThreads; ++i) {
+            threads.emplace_back([this, i]() { workerLoop(i); });
+        }
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        startCv.notify_all();
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    unsigned int size() const { return workerCount; }
+
+    // Call fn(i) for every i in [0, size()) in parallel and wait for all of them.
+    // The caller runs index 0 itself; fn must outlive the call, which it does.
+    template <typename Fn>
+    void run(Fn& fn)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &invoke<Fn>;
+            jobContext = &fn;
+            remaining = workerCount - 1;
+            ++generation;
+        }
+        startCv.notify_all();
+
+        fn(0u);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        doneCv.wait(lock, [this]() { return remaining == 0; });
+        job = nullptr;
+        jobContext = nullptr;
+    }
+
+private:
+    template <typename Fn>
+    static void invoke(void* context, unsigned int index)
+    {
+        (*static_cast<Fn*>(context))(index);
+    }
+
+    void workerLoop(unsigned int index)
+    {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            startCv.wait(lock, [&]() { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+
+            void (*task)(void*, unsigned int) = job;
+            void* context = jobContext;
+            lock.unlock();
+            task(context, index);
+            lock.lock();
+
+            if (--remaining == 0) doneCv.notify_one();
+        }
+    }
+
+    unsigned int workerCount = 1;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable startCv;
+    std::condition_variable doneCv;
+    void (*job)(void*, unsigned int) = nullptr;
+    void* jobContext = nullptr;
+    unsigned int remaining = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+};
+
+#endif
\ No newline at end of file
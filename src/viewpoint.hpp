@@ -3,32 +3,52 @@
 
 #include "vector3.hpp"
 #include "space.hpp"
+#include "utils/triple_buffer.hpp"
+#include "utils/worker_pool.hpp"
+#include "utils/frame_arena.hpp"
 #include <SDL2/SDL.h>
 #include <cmath>
 #include <limits>
 #include <vector>
 #include <algorithm>
 #include <thread>
-#include <future>
+#include <atomic>
 
+// Camera state handed from the control thread to the renderer
+struct CameraPose
+{
+    Vector3 position;
+    double yaw = 0.0; // -180..180
+    double pitch = 0.0; // -90..90
+    double fov = 60.0; // 0..360
+};
+
+// The pose setters and present() belong to the control (input/SDL) thread,
+// renderFrame() may run on a separate render thread. The two only meet in
+// lock-free triple buffers: the renderer latches the newest pose right
+// before generating rays, and the control thread presents the newest frame.
 class Viewpoint
 {
 public:
     Viewpoint()
-        : position(0.0, 0.0, 0.0), yaw(0.0), pitch(0.0), fov(60.0), 
-          screenWidth(800), screenHeight(600),
+        : screenWidth(800), screenHeight(600),
+          frames(std::vector<uint32_t>(screenWidth * screenHeight, 0)),
           window(nullptr), renderer(nullptr), texture(nullptr)
     {
-        pixelBuffer.resize(screenWidth * screenHeight, 0);
+        publishPose();
     }
 
     Viewpoint(const Vector3& pos, double yaw, double pitch, double fov, Space* space, int screenWidth = 800, int screenHeight = 600)
-        : position(pos), yaw(yaw), pitch(pitch), fov(fov), 
-          screenWidth(screenWidth), screenHeight(screenHeight),
+        : screenWidth(screenWidth), screenHeight(screenHeight),
           space(space),
+          frames(std::vector<uint32_t>(screenWidth * screenHeight, 0)),
           window(nullptr), renderer(nullptr), texture(nullptr)
     {
-        pixelBuffer.resize(screenWidth * screenHeight, 0);
+        pose.position = pos;
+        pose.yaw = yaw;
+        pose.pitch = pitch;
+        pose.fov = fov;
+        publishPose();
     }
 
     ~Viewpoint()
@@ -82,19 +102,21 @@ public:
     }
 
     // Getters
-    Vector3 getPosition() const { return position; }
-    double getYaw() const { return yaw; }
-    double getPitch() const { return pitch; }
-    double getFOV() const { return fov; }
+    const CameraPose& getPose() const { return pose; }
+    Vector3 getPosition() const { return pose.position; }
+    double getYaw() const { return pose.yaw; }
+    double getPitch() const { return pose.pitch; }
+    double getFOV() const { return pose.fov; }
     Space* getSpace() const { return space; }
     int getScreenWidth() const { return screenWidth; }
     int getScreenHeight() const { return screenHeight; }
 
-    // Setters
-    void setPosition(const Vector3& pos) { position = pos; }
-    void setYaw(double y) { yaw = y; }
-    void setPitch(double p) { pitch = p; }
-    void setFOV(double f) { fov = f; }
+    // Setters; each one publishes the pose to the renderer
+    void setPose(const CameraPose& p) { pose = p; publishPose(); }
+    void setPosition(const Vector3& pos) { pose.position = pos; publishPose(); }
+    void setYaw(double y) { pose.yaw = y; publishPose(); }
+    void setPitch(double p) { pose.pitch = p; publishPose(); }
+    void setFOV(double f) { pose.fov = f; publishPose(); }
     void setScreenWidth(int w) { screenWidth = w; }
     void setScreenHeight(int h) { screenHeight = h; }
 
@@ -103,51 +125,56 @@ public:
         bool hit;
         double distance;
         const Plane* hitPlane;
+        Space::SnapshotPtr scene; // keeps hitPlane alive when the caller did not pin a snapshot
 
         CastRayResult() : hit(false), distance(std::numeric_limits<double>::infinity()), hitPlane(nullptr) {}
     };
 
-    // Cast a ray given a direction vector
-    CastRayResult castRayDir(const Vector3& dir) const
+    // Contiguous run of planes traced in a frame
+    struct PlaneSpan
     {
-        CastRayResult result;
-
-        if (space == nullptr) return result;
-
-        const double EPS = 1e-9;
-        double closestT = std::numeric_limits<double>::infinity();
-
-        const auto& planes = space->getPlanes();
-        for (const auto& plane : planes) {
-            const Vector3& a = plane.getA();
-            const Vector3& b = plane.getB();
-            const Vector3& c = plane.getC();
+        const Plane* planes;
+        std::size_t count;
+    };
 
-            Vector3 edge1 = b - a;
-            Vector3 edge2 = c - a;
+    // Everything the workers need to trace their rows, set up once per frame
+    struct FrameSetup
+    {
+        const PlaneSpan* spans;
+        std::size_t spanCount;
+        uint32_t* pixels;
+        Vector3 origin;
+        Vector3 forward;
+        Vector3 right;
+        Vector3 up;
+        double aspectRatio;
+        double tanHalfFov;
+    };
 
-            Vector3 h = dir.cross(edge2);
-            double det = edge1.dot(h);
-            
-            // parallel check
-            if (det > -EPS && det < EPS) continue;
+    // Cast a ray given a direction vector against the latest scene version
+    CastRayResult castRayDir(const Vector3& dir) const
+    {
+        if (space == nullptr) return CastRayResult();
 
-            double invDet = 1.0 / det;
-            Vector3 s = position - a;
-            double u = invDet * s.dot(h);
-            if (u < 0.0 || u > 1.0) continue;
+        Space::SnapshotPtr scene = space->snapshot();
+        CastRayResult result = castRayDir(pose.position, dir, *scene);
+        result.scene = std::move(scene);
+        return result;
+    }
 
-            Vector3 q = s.cross(edge1);
-            double v = invDet * dir.dot(q);
-            if (v < 0.0 || u + v > 1.0) continue;
+    // Cast a ray from origin given a direction vector against a pinned snapshot
+    CastRayResult castRayDir(const Vector3& origin, const Vector3& dir, const Space::Snapshot& scene) const
+    {
+        CastRayResult result;
 
-            double t = invDet * edge2.dot(q);
-            if (t > EPS && t < closestT) {
-                closestT = t;
-                result.hit = true;
-                result.distance = t;
-                result.hitPlane = &plane;
-            }
+        intersectPlanes(origin, dir, scene.planes.data(), scene.planes.size(), result);
+        for (const auto& chunk : scene.chunks) {
+            intersectPlanes(origin, dir, chunk->data(), chunk->size(), result);
+        }
+        for (const auto& object : *scene.lodObjects) {
+            if (object.levels.empty()) continue;
+            const auto& finest = *object.levels.front();
+            intersectPlanes(origin, dir, finest.data(), finest.size(), result);
         }
 
         return result;
@@ -171,10 +198,15 @@ public:
     }
 
     // Render a slice of rows (for multi-threading)
-    void renderSlice(int startY, int endY, const Vector3& forward, const Vector3& right, const Vector3& up, double aspectRatio, double tanHalfFov)
+    void renderSlice(int startY, int endY, const FrameSetup& frame)
     {
         const int width = screenWidth;
         const int height = screenHeight;
+        const double aspectRatio = frame.aspectRatio;
+        const double tanHalfFov = frame.tanHalfFov;
+        const Vector3& forward = frame.forward;
+        const Vector3& right = frame.right;
+        const Vector3& up = frame.up;
         
         for (int y = startY; y < endY; ++y) {
             for (int x = 0; x < width; ++x) {
@@ -183,7 +215,10 @@ public:
                 
                 Vector3 rayDir = (forward + right * ndcX + up * ndcY).normalize();
                 
-                auto result = castRayDir(rayDir);
+                CastRayResult result;
+                for (std::size_t i = 0; i < frame.spanCount; ++i) {
+                    intersectPlanes(frame.origin, rayDir, frame.spans[i].planes, frame.spans[i].count, result);
+                }
                 
                 if (!result.hit) continue;
                 
@@ -200,15 +235,21 @@ public:
                 uint8_t b = static_cast<uint8_t>(brightness * 100);
                 uint32_t planeColor = 0xFF000000 | (r << 16) | (g << 8) | b;
                 
-                pixelBuffer[y * width + x] = planeColor;
+                frame.pixels[y * width + x] = planeColor;
             }
         }
     }
 
-    void render()
+    // Trace a frame into the back buffer and hand it to present()
+    void renderFrame()
     {
         if (space == nullptr) return;
 
+        // Pin one scene version for the whole frame; edits publish a new one
+        Space::SnapshotPtr scene = space->snapshot();
+        std::vector<uint32_t>& pixels = frames.writeBuffer();
+        arena.reset();
+
         const int width = screenWidth;
         const int height = screenHeight;
         const int halfHeight = height / 2;
@@ -217,17 +258,21 @@ public:
         for (int y = 0; y < height; ++y) {
             uint32_t color = (y < halfHeight) ? 0xFF1A1A2E : 0xFF3A3A3A;
             for (int x = 0; x < width; ++x) {
-                pixelBuffer[y * width + x] = color;
+                pixels[y * width + x] = color;
             }
         }
 
+        // Latch the newest pose as late as possible, right before ray generation
+        poses.update();
+        const CameraPose camera = poses.readBuffer();
+
         // Prepare camera vectors (shared by all threads)
         double aspectRatio = static_cast<double>(width) / static_cast<double>(height);
-        double fovRad = fov * M_PI / 180.0;
+        double fovRad = camera.fov * M_PI / 180.0;
         double tanHalfFov = std::tan(fovRad / 2.0);
         
-        double yawRad = yaw * M_PI / 180.0;
-        double pitchRad = pitch * M_PI / 180.0;
+        double yawRad = camera.yaw * M_PI / 180.0;
+        double pitchRad = camera.pitch * M_PI / 180.0;
         
         Vector3 forward(
             std::cos(pitchRad) * std::cos(yawRad),
@@ -240,47 +285,320 @@ public:
         Vector3 right = forward.cross(worldUp).normalize();
         Vector3 up = right.cross(forward).normalize();
         
-        // Multi-threaded rendering
-        unsigned int numThreads = std::thread::hardware_concurrency();
-        if (numThreads == 0) numThreads = 4;
-        
-        std::vector<std::future<void>> futures;
-        int rowsPerThread = height / numThreads;
-        
-        for (unsigned int i = 0; i < numThreads; ++i) {
-            int startY = i * rowsPerThread;
-            int endY = (i == numThreads - 1) ? height : (i + 1) * rowsPerThread;
-            
-            futures.push_back(std::async(std::launch::async, 
-                [this, startY, endY, forward, right, up, aspectRatio, tanHalfFov]() {
-                    renderSlice(startY, endY, forward, right, up, aspectRatio, tanHalfFov);
-                }
-            ));
+        FrameSetup frame{nullptr, 0, pixels.data(), camera.position, forward, right, up, aspectRatio, tanHalfFov};
+
+        // Portal culling: from the camera's cell, walk through the portals
+        // visible on screen; with no cell to start from, everything is traced
+        const std::size_t cellCount = scene->cells.size();
+        const int cameraCell = scene->findCell(camera.position);
+        uint8_t* visibleCells = nullptr;
+        if (cameraCell >= 0) {
+            visibleCells = arena.allocate<uint8_t>(cellCount);
+            if (!walkPortals(*scene, cameraCell, frame, visibleCells)) {
+                // step limit hit: draw too much rather than drop a visible room
+                std::fill(visibleCells, visibleCells + cellCount, 1);
+            }
         }
-        
-        // Wait for all threads to complete
-        for (auto& f : futures) {
-            f.get();
+
+        // Trace list for this frame: static planes (or the visible cells'
+        // share of them), every resident chunk and one tessellation level
+        // per LOD object in a visible cell
+        const auto& objects = *scene->lodObjects;
+        const Space::CellIndex* index = scene->cellIndex.get();
+        PlaneSpan* spans = arena.allocate<PlaneSpan>(1 + cellCount + (index ? index->borderPlanes.size() : 0) + scene->chunks.size() + objects.size());
+        std::size_t spanCount = 0;
+        if (visibleCells) {
+            spans[spanCount++] = PlaneSpan{index->outsidePlanes.data(), index->outsidePlanes.size()};
+            for (std::size_t i = 0; i < cellCount; ++i) {
+                if (!visibleCells[i]) continue;
+                spans[spanCount++] = PlaneSpan{index->cellPlanes[i].data(), index->cellPlanes[i].size()};
+            }
+            for (const auto& group : index->borderPlanes) {
+                if (!anyCellVisible(group.cells, visibleCells)) continue;
+                spans[spanCount++] = PlaneSpan{group.planes.data(), group.planes.size()};
+            }
+        } else {
+            spans[spanCount++] = PlaneSpan{scene->planes.data(), scene->planes.size()};
         }
+        for (const auto& chunk : scene->chunks) {
+            spans[spanCount++] = PlaneSpan{chunk->data(), chunk->size()};
+        }
+
+        if (lodLevels.size() != objects.size()) lodLevels.resize(objects.size(), 0);
+        const double pixelScale = 0.5 * height / tanHalfFov;
+        for (std::size_t i = 0; i < objects.size(); ++i) {
+            if (objects[i].levels.empty()) continue;
+            if (visibleCells && !anyCellVisible(index->lodObjectCells[i], visibleCells)) continue;
+            lodLevels[i] = selectLod(objects[i], camera.position, pixelScale, lodLevels[i]);
+            const auto& planes = *objects[i].levels[lodLevels[i]];
+            spans[spanCount++] = PlaneSpan{planes.data(), planes.size()};
+        }
+
+        std::size_t planeCount = 0;
+        for (std::size_t i = 0; i < spanCount; ++i) {
+            planeCount += spans[i].count;
+        }
+        tracedPlanes.store(planeCount, std::memory_order_relaxed);
+
+        frame.spans = spans;
+        frame.spanCount = spanCount;
+
+        // Multi-threaded rendering on the persistent pool
+        const unsigned int numThreads = pool.size();
+        const int rowsPerThread = height / numThreads;
+        auto slice = [this, &frame, numThreads, rowsPerThread, height](unsigned int i) {
+            int startY = i * rowsPerThread;
+            int endY = (i == numThreads - 1) ? height : (i + 1) * rowsPerThread;
+            renderSlice(startY, endY, frame);
+        };
+        pool.run(slice);
 
-        SDL_UpdateTexture(texture, nullptr, pixelBuffer.data(), width * sizeof(uint32_t));
+        frames.publish();
+    }
+
+    // Show the newest finished frame; returns false if there was none since the last call
+    bool present()
+    {
+        if (!frames.update()) return false;
+
+        SDL_UpdateTexture(texture, nullptr, frames.readBuffer().data(), screenWidth * sizeof(uint32_t));
         SDL_RenderClear(renderer);
         SDL_RenderCopy(renderer, texture, nullptr, nullptr);
         SDL_RenderPresent(renderer);
+        return true;
+    }
+
+    // Number of planes the last frame traced against
+    std::size_t getTracedPlanes() const { return tracedPlanes.load(std::memory_order_relaxed); }
+
+    // Trace and present on the calling thread
+    void render()
+    {
+        renderFrame();
+        present();
     }
 
 private:
-    Vector3 position;
-    double yaw; // -180..180
-    double pitch; // -90..90
-    double fov; // 0..360
+    // LOD level k is kept while the object's projected radius is at least
+    // lodFinestPixels / 2^k; switching waits until the size is past the
+    // threshold by lodHysteresis so objects near a boundary do not pop.
+    static constexpr double lodFinestPixels = 96.0;
+    static constexpr double lodHysteresis = 0.15;
+
+    static int selectLod(const Space::LodObject& object, const Vector3& eye, double pixelScale, int previous)
+    {
+        const int coarsest = static_cast<int>(object.levels.size()) - 1;
+        const double distance = (object.center - eye).magnitude();
+        if (distance <= object.radius) return 0;
+
+        const double pixels = object.radius / distance * pixelScale;
+        auto threshold = [](int k) { return lodFinestPixels / static_cast<double>(1 << k); };
+
+        int level = std::min(previous, coarsest);
+        while (level > 0 && pixels >= threshold(level - 1) * (1.0 + lodHysteresis)) --level;
+        while (level < coarsest && pixels < threshold(level) * (1.0 - lodHysteresis)) ++level;
+        return level;
+    }
+
+    // Screen-space rectangle in normalized device coordinates
+    struct ScreenRect
+    {
+        double minX;
+        double minY;
+        double maxX;
+        double maxY;
+    };
+
+    // Portal steps allowed per portal and frame before giving up on culling
+    static constexpr std::size_t maxPortalSteps = 16;
+
+    // Bounding rectangle of a portal on screen, after clipping it against
+    // the near plane; false if nothing of it is in front of the camera.
+    // The tracer has no near plane, so the clip distance is kept as small
+    // as the tracer's own epsilon. A camera on the portal's plane sees every
+    // corner at depth ~0; it counts as seeing through the whole screen, since
+    // the tracer also ignores the wall around the opening at that distance.
+    static bool projectPortal(const Space::Portal& portal, const FrameSetup& frame, ScreenRect& rect)
+    {
+        const double NEAR = 1e-9;
+        const double EPS = 1e-6;
+        const double inf = std::numeric_limits<double>::infinity();
+
+        if (onPortalPlane(portal, frame.origin, EPS)) {
+            rect = ScreenRect{-1.0, -1.0, 1.0, 1.0};
+            return true;
+        }
+
+        // camera space corners
+        double cx[4], cy[4], cz[4];
+        for (int i = 0; i < 4; ++i) {
+            Vector3 d = portal.corners[i] - frame.origin;
+            cx[i] = d.dot(frame.right);
+            cy[i] = d.dot(frame.up);
+            cz[i] = d.dot(frame.forward);
+        }
+
+        rect = ScreenRect{inf, inf, -inf, -inf};
+        bool any = false;
+        auto addPoint = [&](double x, double y, double z) {
+            double sx = x / (z * frame.tanHalfFov * frame.aspectRatio);
+            double sy = y / (z * frame.tanHalfFov);
+            rect.minX = std::min(rect.minX, sx);
+            rect.minY = std::min(rect.minY, sy);
+            rect.maxX = std::max(rect.maxX, sx);
+            rect.maxY = std::max(rect.maxY, sy);
+            any = true;
+        };
+
+        // keep corners in front, and where an edge crosses the near plane
+        for (int i = 0; i < 4; ++i) {
+            int j = (i + 1) % 4;
+            if (cz[i] >= NEAR) addPoint(cx[i], cy[i], cz[i]);
+            if ((cz[i] >= NEAR) != (cz[j] >= NEAR)) {
+                double t = (NEAR - cz[i]) / (cz[j] - cz[i]);
+                addPoint(cx[i] + (cx[j] - cx[i]) * t, cy[i] + (cy[j] - cy[i]) * t, NEAR);
+            }
+        }
+
+        return any;
+    }
+
+    // True if p lies within eps of the plane through the portal
+    static bool onPortalPlane(const Space::Portal& portal, const Vector3& p, double eps)
+    {
+        const Vector3* c = portal.corners;
+        const Vector3 normal = (c[1] - c[0]).cross(c[2] - c[0]).normalize();
+        if (normal.dot(normal) == 0.0) return false;
+        return std::abs((p - c[0]).dot(normal)) <= eps;
+    }
+
+    // Breadth-first walk from the camera's cell. Every cell remembers the
+    // screen area it has been reached with and is only entered again when a
+    // portal shows it more than that, so loops of portals settle quickly.
+    // Returns false if the step limit was hit before the walk settled.
+    bool walkPortals(const Space::Snapshot& scene, int startCell, const FrameSetup& frame, uint8_t* visible)
+    {
+        const std::size_t cellCount = scene.cells.size();
+        const std::size_t maxSteps = maxPortalSteps * scene.portals.size() + cellCount;
+
+        ScreenRect* reached = arena.allocate<ScreenRect>(cellCount);
+        const double inf = std::numeric_limits<double>::infinity();
+        std::fill(reached, reached + cellCount, ScreenRect{inf, inf, -inf, -inf});
+        std::fill(visible, visible + cellCount, 0);
+
+        // queue of cells whose reached area grew and has to be pushed on
+        int* queue = arena.allocate<int>(maxSteps + 1);
+        std::size_t head = 0;
+        std::size_t tail = 0;
+
+        reached[startCell] = ScreenRect{-1.0, -1.0, 1.0, 1.0};
+        visible[startCell] = 1;
+        queue[tail++] = startCell;
+
+        while (head < tail) {
+            const int cell = queue[head++];
+            const ScreenRect rect = reached[cell];
+
+            for (int p : scene.cellIndex->cellPortals[cell]) {
+                const Space::Portal& portal = scene.portals[p];
+                ScreenRect portalRect;
+                if (!projectPortal(portal, frame, portalRect)) continue;
+
+                ScreenRect clipped{
+                    std::max(rect.minX, portalRect.minX), std::max(rect.minY, portalRect.minY),
+                    std::min(rect.maxX, portalRect.maxX), std::min(rect.maxY, portalRect.maxY)
+                };
+                if (clipped.minX > clipped.maxX || clipped.minY > clipped.maxY) continue;
+
+                const int next = (portal.cellA == cell) ? portal.cellB : portal.cellA;
+                ScreenRect& seen = reached[next];
+                if (seen.minX <= clipped.minX && seen.minY <= clipped.minY &&
+                    seen.maxX >= clipped.maxX && seen.maxY >= clipped.maxY) continue;
+
+                seen = ScreenRect{
+                    std::min(seen.minX, clipped.minX), std::min(seen.minY, clipped.minY),
+                    std::max(seen.maxX, clipped.maxX), std::max(seen.maxY, clipped.maxY)
+                };
+                visible[next] = 1;
+
+                if (tail > maxSteps) return false;
+                queue[tail++] = next;
+            }
+        }
+
+        return true;
+    }
+
+    // Objects and planes in no cell are always traced, the rest if any cell they touch is
+    static bool anyCellVisible(const std::vector<int>& cells, const uint8_t* visible)
+    {
+        if (cells.empty()) return true;
+        for (int cell : cells) {
+            if (visible[cell]) return true;
+        }
+        return false;
+    }
+
+    // Moller-Trumbore against one list of planes, keeping the closest hit in result
+    void intersectPlanes(const Vector3& origin, const Vector3& dir, const Plane* planes, std::size_t count, CastRayResult& result) const
+    {
+        const double EPS = 1e-9;
+
+        for (std::size_t i = 0; i < count; ++i) {
+            const Plane& plane = planes[i];
+            const Vector3& a = plane.getA();
+            const Vector3& b = plane.getB();
+            const Vector3& c = plane.getC();
+
+            Vector3 edge1 = b - a;
+            Vector3 edge2 = c - a;
+
+            Vector3 h = dir.cross(edge2);
+            double det = edge1.dot(h);
+            
+            // parallel check
+            if (det > -EPS && det < EPS) continue;
+
+            double invDet = 1.0 / det;
+            Vector3 s = origin - a;
+            double u = invDet * s.dot(h);
+            if (u < 0.0 || u > 1.0) continue;
+
+            Vector3 q = s.cross(edge1);
+            double v = invDet * dir.dot(q);
+            if (v < 0.0 || u + v > 1.0) continue;
+
+            double t = invDet * edge2.dot(q);
+            if (t > EPS && t < result.distance) {
+                result.hit = true;
+                result.distance = t;
+                result.hitPlane = &plane;
+            }
+        }
+    }
+
+    void publishPose()
+    {
+        poses.writeBuffer() = pose;
+        poses.publish();
+    }
+
+    CameraPose pose; // control thread copy
     int screenWidth;
     int screenHeight;
 
     Space* space = nullptr;
 
+    TripleBuffer<CameraPose> poses;              // control thread -> renderer
+    TripleBuffer<std::vector<uint32_t>> frames;  // renderer -> control thread
+
+    // Render thread only; reused every frame so steady-state frames do not allocate
+    WorkerPool pool;
+    FrameArena arena;
+    std::vector<int> lodLevels; // level picked last frame, per LOD object
+    std::atomic<std::size_t> tracedPlanes{0};
+
     // SDL resources
-    std::vector<uint32_t> pixelBuffer;
     SDL_Window* window;
     SDL_Renderer* renderer;
     SDL_Texture* texture;